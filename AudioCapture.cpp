@@ -3,13 +3,22 @@
 
 #define _USE_MATH_DEFINES
 
+#include <algorithm>
+#include <emmintrin.h>
 #include <math.h>
+#include <random>
 
 Visualizer visualizer;
 
-AudioCapture::AudioCapture(DataSender* data_sender, unsigned input_buffer_size, unsigned bins_size) :
+AudioCapture::AudioCapture(
+    DataSender* data_sender, RealtimeProfile* realtime_profile, analysis_t analysis, unsigned packet_interval_ms, unsigned input_buffer_size, unsigned bins_size
+) :
     data_sender(data_sender),
-    input_buffer_size(input_buffer_size) {
+    realtime_profile(realtime_profile),
+    analysis(analysis),
+    packet_interval_ms(packet_interval_ms),
+    input_buffer_size(input_buffer_size),
+    bins_size(bins_size) {
     this->rtaudio = std::make_unique<RtAudio>(RtAudio(RtAudio::WINDOWS_WASAPI));
 
     printf("[INFO] RtAudio API: %s\n", this->rtaudio->getApiName(this->rtaudio->getCurrentApi()).c_str());
@@ -23,49 +32,26 @@ AudioCapture::AudioCapture(DataSender* data_sender, unsigned input_buffer_size,
     this->parameters.deviceId       = device_info.ID;
     this->parameters.nChannels      = device_info.outputChannels;
     this->sample_rate               = device_info.preferredSampleRate;
-    this->input_buffer_size         = input_buffer_size;
-    this->output_buffer_size        = this->input_buffer_size / 2 + 1;
+    this->input_buffer_size         = (this->analysis == analysis_t::filterbank) ? FILTERBANK_BUFFER_SIZE : input_buffer_size;
 
     printf(
-        "[++++] Registered audio device:\n\tId: %d\n\tChannels: %d\n\tSample rate: %d\n\tFormats: %#x\n",
+        "[++++] Registered audio device:\n\tId: %d\n\tChannels: %d\n\tSample rate: %d\n\tFormats: %#x\n\tAnalysis: %s\n",
         this->parameters.deviceId,
         this->parameters.nChannels,
         this->sample_rate,
-        device_info.nativeFormats
+        device_info.nativeFormats,
+        (this->analysis == analysis_t::filterbank) ? "filter bank" : "FFT"
     );
+}
 
-    // Reserve memory for magnitude data
-    this->data.resize(this->parameters.nChannels);
-
-    // Initialize the bins
-    this->bins.resize(this->parameters.nChannels, {});
-    for (unsigned channel_index = 0; channel_index < this->bins.size(); ++channel_index) {
-        this->bins[channel_index].resize(bins_size, {});
-        for (unsigned bin_index = 0; bin_index < this->bins[channel_index].size(); ++bin_index) {
-            this->bins[channel_index][bin_index].lower_frequency = (bin_index == 0) ? 0 : this->bins[channel_index][bin_index - 1].upper_frequency;
-            this->bins[channel_index][bin_index].upper_frequency =
-                this->bins[channel_index][bin_index].lower_frequency + (MAX_FREQUENCY / static_cast<double>(this->bins[channel_index].size()));
-        }
-    }
-
-    // Calculate which frame index falls into what bin
-    this->frame_index_to_bin_index.resize(this->output_buffer_size, this->bins[0].size() - 1); // All frame indices that don't belong to any bin will be placed in the last bin (init value)
-    for (unsigned frame_index = 0; frame_index < this->output_buffer_size; ++frame_index) {
-        double frequency = static_cast<double>(frame_index) * static_cast<double>(this->sample_rate) / static_cast<double>(this->input_buffer_size);
-        for (unsigned bin_index = 0; bin_index < this->bins[0].size(); ++bin_index) { // Channel doesn't matter as bins have the same bandwith for all channels
-            if (this->bins[0][bin_index].lower_frequency <= frequency && this->bins[0][bin_index].upper_frequency > frequency) {
-                this->frame_index_to_bin_index[frame_index] = bin_index;
-                break; // Continue with next frame_index when the correct bin was found
-            }
-        }
-    }
-
-    this->hann_window.resize(this->input_buffer_size);
-    for (unsigned frame_index = 0; frame_index < this->input_buffer_size; ++frame_index) {
-        this->hann_window[frame_index] = 0.5 * (1.0 - cos(2.0 * M_PI * frame_index / (this->input_buffer_size - 1)));
-    }
-    this->fftw_in.resize(this->input_buffer_size, 0.);
-    this->fftw_out = reinterpret_cast<fftw_complex*>(fftw_malloc(sizeof(fftw_complex) * this->output_buffer_size));
+// Offline instance without an audio device, i.e., for benchmarking
+AudioCapture::AudioCapture(analysis_t analysis, unsigned packet_interval_ms, unsigned channels_size, unsigned sample_rate, unsigned input_buffer_size, unsigned bins_size) :
+    analysis(analysis),
+    packet_interval_ms(packet_interval_ms),
+    sample_rate(sample_rate),
+    input_buffer_size(input_buffer_size),
+    bins_size(bins_size) {
+    this->parameters.nChannels = channels_size;
 }
 
 AudioCapture::~AudioCapture() {
@@ -80,56 +66,178 @@ int AudioCapture::record(void* output_buffer, void* input_buffer, unsigned input
 
     AudioCapture* audio_capture = reinterpret_cast<AudioCapture*>(user_data);
 
-    bool autoscale = ((stream_time - audio_capture->last_autoscale) > (AUTOSCALE_TIME_WINDOW_MS / 1000.));
-    if (autoscale) { audio_capture->last_autoscale = stream_time; }
+    // RtAudio owns the callback thread, so the real-time profile can only be applied from within it
+    if (!audio_capture->realtime_thread_is_applied) {
+        if (audio_capture->realtime_profile) { audio_capture->realtime_profile->apply_audio_thread(audio_capture->realtime_task); }
+        audio_capture->realtime_thread_is_applied = true;
+    }
 
-    for (unsigned channel_index = 0; channel_index < audio_capture->parameters.nChannels; ++channel_index) {
-        for (unsigned frame_index = 0; frame_index < input_buffer_size; ++frame_index) {
-            audio_capture->fftw_in[frame_index] = (reinterpret_cast<double*>(input_buffer))[frame_index * audio_capture->parameters.nChannels + channel_index]
-                * audio_capture->hann_window[frame_index];
+    if (audio_capture->analyze(reinterpret_cast<double*>(input_buffer), input_buffer_size, stream_time)) {
+        audio_capture->packet.set_payload(audio_capture->data.data(), audio_capture->data.size());
+        audio_capture->data_sender->enqueue(audio_capture->packet);
+    }
+
+    //visualizer.render(audio_capture->bins); // Uncomment to enable console visualizer
+
+    return 0;
+}
+
+// Returns true if data holds new magnitudes to send
+bool AudioCapture::analyze(const double* input, unsigned frames_size, double stream_time) {
+    if ((stream_time - this->last_autoscale) > (AUTOSCALE_TIME_WINDOW_MS / 1000.)) {
+        this->last_autoscale       = stream_time;
+        this->autoscale_is_pending = true;
+    }
+
+    bool silent = AudioCapture::is_silent(input, frames_size * this->parameters.nChannels);
+    if (silent && this->silence_is_settled) {
+        // Nothing to analyze or send, only keep track of the decay to apply once audio returns
+        ++this->silent_blocks;
+        if (this->autoscale_is_pending) {
+            ++this->silent_autoscales;
+            this->autoscale_is_pending = false;
+        }
+        return false;
+    }
+
+    if (!silent && this->silence_is_settled) {
+        for (std::vector<Bin>& channel_bins : this->bins) {
+            for (Bin& bin : channel_bins) {
+                bin.decay_envelope(std::pow(this->block_release, this->silent_blocks), this->silent_autoscales);
+            }
         }
+        if (this->analysis == analysis_t::filterbank) { this->filter_bank.reset(); }
+
+        this->silence_is_settled = false;
+        this->silent_blocks      = 0;
+        this->silent_autoscales  = 0;
+    }
 
-        fftw_execute(audio_capture->fftw);
+    switch (this->analysis) {
+        case analysis_t::filterbank: {
+            if (!this->analyze_filterbank(input, frames_size)) { return false; }
+            break;
+        }
+        default: {
+            this->analyze_fft(input, silent);
+            break;
+        }
+    }
+
+    for (unsigned channel_index = 0; channel_index < this->parameters.nChannels; ++channel_index) {
+        this->weight_channel(channel_index, this->autoscale_is_pending);
+    }
+    this->autoscale_is_pending = false;
+
+    // Settle once the envelopes have fully decayed and the DataSender has resent the zero packet often enough
+    if (silent && std::all_of(this->data.begin(), this->data.end(), [](uint8_t magnitude) { return magnitude == 0; })) {
+        if (++this->zero_packet_count >= DataSender::RESEND_ZERO_PACKET_COUNT) { this->silence_is_settled = true; }
+    } else {
+        this->zero_packet_count = 0;
+    }
+
+    return true;
+}
+
+void AudioCapture::analyze_fft(const double* input, bool silent) {
+    for (unsigned channel_index = 0; channel_index < this->parameters.nChannels; ++channel_index) {
+        if (silent) {
+            // Skip the FFT and let the envelopes release
+            for (Bin& bin : this->bins[channel_index]) {
+                bin.decay_envelope(this->block_release);
+            }
+            continue;
+        }
+
+        for (unsigned frame_index = 0; frame_index < this->input_buffer_size; ++frame_index) {
+            this->fftw_in[frame_index] = input[frame_index * this->parameters.nChannels + channel_index] * this->hann_window[frame_index];
+        }
+
+        fftw_execute(this->fftw);
 
         // Reset all magnitudes
-        for (Bin& bin : audio_capture->bins[channel_index]) {
+        for (Bin& bin : this->bins[channel_index]) {
             bin.magnitude = 0.;
         }
 
         // Bin the magnitudes
-        for (unsigned frame_index = 0; frame_index < audio_capture->output_buffer_size; ++frame_index) {
-            double frame_magnitude = std::sqrt(
-                audio_capture->fftw_out[frame_index][0] * audio_capture->fftw_out[frame_index][0]
-                + audio_capture->fftw_out[frame_index][1] * audio_capture->fftw_out[frame_index][1]
-            );
-            audio_capture->bins[channel_index][audio_capture->frame_index_to_bin_index[frame_index]].magnitude += frame_magnitude;
+        for (unsigned frame_index = 0; frame_index < this->output_buffer_size; ++frame_index) {
+            double frame_magnitude =
+                std::sqrt(this->fftw_out[frame_index][0] * this->fftw_out[frame_index][0] + this->fftw_out[frame_index][1] * this->fftw_out[frame_index][1]);
+            this->bins[channel_index][this->frame_index_to_bin_index[frame_index]].magnitude += frame_magnitude;
         }
 
         // Follow the magnitudes' envelopes
-        for (Bin& bin : audio_capture->bins[channel_index]) {
+        for (Bin& bin : this->bins[channel_index]) {
             bin.follow_envelope();
         }
+    }
+}
+
+// Returns true once packet_interval_frames have been processed since the last packet
+bool AudioCapture::analyze_filterbank(const double* input, unsigned frames_size) {
+    this->filter_bank.process(input, frames_size);
 
-        // Autoscale the envelopes
-        for (Bin& bin : audio_capture->bins[channel_index]) {
-            if (bin.envelope > bin.max_envelope) { bin.max_envelope = bin.envelope; }
-            if (autoscale && ((bin.max_envelope * AudioCapture::AUTOSCALE_VALUE) > bin.envelope)) { bin.max_envelope *= AudioCapture::AUTOSCALE_VALUE; }
+    this->frames_since_packet += frames_size;
+    if (this->frames_since_packet < this->packet_interval_frames) { return false; }
+    this->frames_since_packet %= this->packet_interval_frames;
+
+    // The filter bank already follows the envelopes sample by sample
+    for (unsigned channel_index = 0; channel_index < this->parameters.nChannels; ++channel_index) {
+        for (unsigned bin_index = 0; bin_index < this->bins[channel_index].size(); ++bin_index) {
+            Bin& bin      = this->bins[channel_index][bin_index];
+            bin.magnitude = this->filter_bank.get_envelope(channel_index, bin_index);
+            bin.envelope  = bin.magnitude;
         }
+    }
+    return true;
+}
 
-        // Weights MUST be combined no more than 1.
-        audio_capture->data[channel_index] = static_cast<unsigned char>(std::min(
-            255.
-                * (0.7 * audio_capture->bins[channel_index][0].get_normalized_envelope() + 0.2 * audio_capture->bins[channel_index][1].get_normalized_envelope()
-                   + 0.1 * audio_capture->bins[channel_index][2].get_normalized_envelope()),
-            255.
-        ));
+void AudioCapture::weight_channel(unsigned channel_index, bool autoscale) {
+    // Autoscale the envelopes
+    for (Bin& bin : this->bins[channel_index]) {
+        if (bin.envelope > bin.max_envelope) { bin.max_envelope = bin.envelope; }
+        if (autoscale && ((bin.max_envelope * AudioCapture::AUTOSCALE_VALUE) > bin.envelope)) { bin.max_envelope *= AudioCapture::AUTOSCALE_VALUE; }
     }
 
-    audio_capture->data_sender->enqueue(Packet(Packet::destination_t::device, Packet::type_t::data, audio_capture->data.data(), audio_capture->data.size()));
+    // Weights MUST be combined no more than 1.
+    this->data[channel_index] = static_cast<unsigned char>(std::min(
+        255.
+            * (0.7 * this->bins[channel_index][0].get_normalized_envelope() + 0.2 * this->bins[channel_index][1].get_normalized_envelope()
+               + 0.1 * this->bins[channel_index][2].get_normalized_envelope()),
+        255.
+    ));
+}
 
-    //visualizer.render(audio_capture->bins); // Uncomment to enable console visualizer
+// Cheap RMS/peak gate over all interleaved channels, two samples at a time
+bool AudioCapture::is_silent(const double* samples, size_t samples_size) {
+    if (samples_size == 0) { return true; }
 
-    return 0;
+    const __m128d sign_mask = _mm_set1_pd(-0.);
+
+    __m128d sum  = _mm_setzero_pd();
+    __m128d peak = _mm_setzero_pd();
+
+    size_t index = 0;
+    for (; index + 2 <= samples_size; index += 2) {
+        __m128d sample = _mm_loadu_pd(samples + index);
+        sum            = _mm_add_pd(sum, _mm_mul_pd(sample, sample));
+        peak           = _mm_max_pd(peak, _mm_andnot_pd(sign_mask, sample));
+    }
+
+    double sums[2]  = {};
+    double peaks[2] = {};
+    _mm_storeu_pd(sums, sum);
+    _mm_storeu_pd(peaks, peak);
+
+    double total_sum  = sums[0] + sums[1];
+    double total_peak = std::max(peaks[0], peaks[1]);
+    for (; index < samples_size; ++index) {
+        total_sum += samples[index] * samples[index];
+        total_peak = std::max(total_peak, fabs(samples[index]));
+    }
+
+    return (total_peak < SILENCE_PEAK_THRESHOLD) && (std::sqrt(total_sum / static_cast<double>(samples_size)) < SILENCE_RMS_THRESHOLD);
 }
 
 unsigned AudioCapture::open_stream(void) {
@@ -142,10 +250,10 @@ unsigned AudioCapture::open_stream(void) {
         return result;
     }
 
-    if ((this->fftw = fftw_plan_dft_r2c_1d(this->input_buffer_size, this->fftw_in.data(), this->fftw_out, FFTW_ESTIMATE)) == NULL) {
-        printf("[CRIT] Failed to create FFTW plan!\n");
-        return 1;
-    }
+    // RtAudio may have changed the buffer size, so the analysis is prepared only now
+    if (this->prepare_analysis() != 0) { return 1; }
+
+    this->lock_buffers();
 
     if ((result = this->rtaudio->startStream()) != RTAUDIO_NO_ERROR) {
         printf("[CRIT] Failed to start stream with error code %d!\n", result);
@@ -155,9 +263,85 @@ unsigned AudioCapture::open_stream(void) {
     return 0;
 }
 
+unsigned AudioCapture::prepare_analysis(void) {
+    this->output_buffer_size = this->input_buffer_size / 2 + 1;
+
+    // Reserve memory for magnitude data
+    this->data.resize(this->parameters.nChannels);
+    this->packet.set_payload(this->data.data(), this->data.size());
+
+    // Initialize the bins
+    this->bins.resize(this->parameters.nChannels, {});
+    for (unsigned channel_index = 0; channel_index < this->bins.size(); ++channel_index) {
+        this->bins[channel_index].resize(this->bins_size, {});
+        for (unsigned bin_index = 0; bin_index < this->bins[channel_index].size(); ++bin_index) {
+            this->bins[channel_index][bin_index].lower_frequency = (bin_index == 0) ? 0 : this->bins[channel_index][bin_index - 1].upper_frequency;
+            this->bins[channel_index][bin_index].upper_frequency =
+                this->bins[channel_index][bin_index].lower_frequency + (MAX_FREQUENCY / static_cast<double>(this->bins[channel_index].size()));
+        }
+    }
+
+    if (this->analysis == analysis_t::filterbank) {
+        // Match the release of the FFT envelope follower at its default buffer size, so both analyses look alike
+        double fft_block_ms = 1000. * static_cast<double>(INPUT_BUFFER_SIZE) / static_cast<double>(this->sample_rate);
+        double release_ms   = -fft_block_ms / log(1. - ENVELOPE_FOLLOWER_RELEASE);
+
+        this->filter_bank.initialize(this->sample_rate, this->parameters.nChannels, this->bins_size, FILTERBANK_ATTACK_MS, release_ms);
+        for (unsigned bin_index = 0; bin_index < this->bins_size; ++bin_index) {
+            this->filter_bank.set_band(this->sample_rate, bin_index, this->bins[0][bin_index].lower_frequency, this->bins[0][bin_index].upper_frequency);
+        }
+
+        this->packet_interval_frames = std::max(this->sample_rate * this->packet_interval_ms / 1000, 1u);
+        this->block_release          = std::pow(1. - this->filter_bank.get_release(), this->input_buffer_size);
+        return 0;
+    }
+
+    // Calculate which frame index falls into what bin
+    this->frame_index_to_bin_index.resize(this->output_buffer_size, this->bins[0].size() - 1); // All frame indices that don't belong to any bin will be placed in the last bin (init value)
+    for (unsigned frame_index = 0; frame_index < this->output_buffer_size; ++frame_index) {
+        double frequency = static_cast<double>(frame_index) * static_cast<double>(this->sample_rate) / static_cast<double>(this->input_buffer_size);
+        for (unsigned bin_index = 0; bin_index < this->bins[0].size(); ++bin_index) { // Channel doesn't matter as bins have the same bandwith for all channels
+            if (this->bins[0][bin_index].lower_frequency <= frequency && this->bins[0][bin_index].upper_frequency > frequency) {
+                this->frame_index_to_bin_index[frame_index] = bin_index;
+                break; // Continue with next frame_index when the correct bin was found
+            }
+        }
+    }
+
+    this->hann_window.resize(this->input_buffer_size);
+    for (unsigned frame_index = 0; frame_index < this->input_buffer_size; ++frame_index) {
+        this->hann_window[frame_index] = 0.5 * (1.0 - cos(2.0 * M_PI * frame_index / (this->input_buffer_size - 1)));
+    }
+    this->fftw_in.resize(this->input_buffer_size, 0.);
+    this->fftw_out = reinterpret_cast<fftw_complex*>(fftw_malloc(sizeof(fftw_complex) * this->output_buffer_size));
+
+    if ((this->fftw = fftw_plan_dft_r2c_1d(this->input_buffer_size, this->fftw_in.data(), this->fftw_out, FFTW_ESTIMATE)) == NULL) {
+        printf("[CRIT] Failed to create FFTW plan!\n");
+        return 1;
+    }
+
+    this->block_release = 1. - ENVELOPE_FOLLOWER_RELEASE;
+    return 0;
+}
+
+void AudioCapture::lock_buffers(void) {
+    if (!this->realtime_profile) { return; }
+
+    this->realtime_profile->lock_buffer("hann window", this->hann_window);
+    this->realtime_profile->lock_buffer("FFTW input", this->fftw_in);
+    this->realtime_profile->lock_buffer("FFTW output", this->fftw_out, sizeof(fftw_complex) * this->output_buffer_size);
+    this->realtime_profile->lock_buffer("bin index", this->frame_index_to_bin_index);
+    this->realtime_profile->lock_buffer("data", this->data);
+    this->realtime_profile->lock_buffer("packet", this->packet.get_payload_buffer());
+    for (std::vector<Bin>& channel_bins : this->bins) {
+        this->realtime_profile->lock_buffer("bins", channel_bins);
+    }
+    this->filter_bank.lock_buffers(this->realtime_profile);
+}
+
 unsigned AudioCapture::close_stream(void) {
     RtAudioErrorType result = RTAUDIO_NO_ERROR;
-    if (this->rtaudio->isStreamRunning()) {
+    if (this->rtaudio && this->rtaudio->isStreamRunning()) {
         if ((result = this->rtaudio->stopStream()) != RTAUDIO_NO_ERROR) {
             printf("[CRIT] Failed to stop stream with error code %d!\n", result);
             return result;
@@ -169,10 +353,155 @@ unsigned AudioCapture::close_stream(void) {
         this->fftw = nullptr;
     }
 
-    if (this->rtaudio->isStreamOpen()) { this->rtaudio->closeStream(); }
+    if (this->rtaudio && this->rtaudio->isStreamOpen()) { this->rtaudio->closeStream(); }
     return 0;
 }
 
 unsigned AudioCapture::initialize(void) {
     return this->open_stream();
 }
+
+// Runs both analyses offline on the same synthetic kick drum pattern and compares their CPU time and latency.
+// Blocks are fed back to back, so this can't reflect how often the audio device actually delivers callbacks of the requested size.
+void AudioCapture::benchmark(unsigned packet_interval_ms) {
+    constexpr unsigned SAMPLE_RATE        = 48000;
+    constexpr unsigned CHANNELS_SIZE      = 2;
+    constexpr unsigned DURATION_MS        = 10000;
+    constexpr unsigned KICK_INTERVAL_MS   = 500;
+    constexpr double KICK_FREQUENCY       = 60.;
+    constexpr double KICK_DECAY_MS        = 80.;
+    constexpr double NOISE_AMPLITUDE      = 0.003; // Keeps the silence fast path out of the measurement
+    constexpr uint8_t DETECTION_MAGNITUDE = 128;
+
+    unsigned frames_size         = SAMPLE_RATE * DURATION_MS / 1000;
+    unsigned kick_interval_size  = SAMPLE_RATE * KICK_INTERVAL_MS / 1000;
+    std::vector<double> input    = std::vector<double>(frames_size * CHANNELS_SIZE, 0.);
+    std::vector<unsigned> onsets = {};
+
+    // Noise floor plus kicks, each shifted differently against the block boundaries
+    std::mt19937 random(42);
+    std::uniform_real_distribution<double> noise(-NOISE_AMPLITUDE, NOISE_AMPLITUDE);
+    for (unsigned frame_index = 0; frame_index < frames_size; ++frame_index) {
+        for (unsigned channel_index = 0; channel_index < CHANNELS_SIZE; ++channel_index) {
+            input[frame_index * CHANNELS_SIZE + channel_index] = noise(random);
+        }
+    }
+    for (unsigned onset = kick_interval_size; onset + kick_interval_size <= frames_size; onset += kick_interval_size) {
+        onsets.push_back(onset + (static_cast<unsigned>(onsets.size()) * 97) % INPUT_BUFFER_SIZE);
+    }
+    for (unsigned onset : onsets) {
+        for (unsigned frame_index = onset; frame_index < std::min(onset + kick_interval_size, frames_size); ++frame_index) {
+            double time  = static_cast<double>(frame_index - onset) / static_cast<double>(SAMPLE_RATE);
+            double value = 0.8 * exp(-1000. * time / KICK_DECAY_MS) * sin(2. * M_PI * KICK_FREQUENCY * time);
+            for (unsigned channel_index = 0; channel_index < CHANNELS_SIZE; ++channel_index) {
+                input[frame_index * CHANNELS_SIZE + channel_index] += value;
+            }
+        }
+    }
+
+    printf("[INFO] Benchmarking %u kicks over %ums of audio...\n", static_cast<unsigned>(onsets.size()), DURATION_MS);
+
+    // CPU time of the calling thread only, so the live capture and other threads don't distort the comparison. Only as precise as the scheduler tick.
+    auto get_thread_cpu_time_ms = [](void) {
+        FILETIME creation_time = {};
+        FILETIME exit_time     = {};
+        FILETIME kernel_time   = {};
+        FILETIME user_time     = {};
+        if (!GetThreadTimes(GetCurrentThread(), &creation_time, &exit_time, &kernel_time, &user_time)) { return 0.; }
+
+        // FILETIMEs count 100ns intervals
+        auto to_ms = [](const FILETIME& time) { return static_cast<double>((static_cast<ULONG64>(time.dwHighDateTime) << 32) | time.dwLowDateTime) / 10000.; };
+        return to_ms(kernel_time) + to_ms(user_time);
+    };
+
+    // Fills the frame at which each packet is available and its magnitude
+    auto run = [&](AudioCapture& audio_capture, unsigned block_size, std::vector<unsigned>& packet_frames, std::vector<uint8_t>& packet_magnitudes) {
+        packet_frames.reserve(frames_size / block_size);
+        packet_magnitudes.reserve(frames_size / block_size);
+
+        for (unsigned frame_index = 0; frame_index + block_size <= frames_size; frame_index += block_size) {
+            double stream_time = static_cast<double>(frame_index) / static_cast<double>(SAMPLE_RATE);
+            if (audio_capture.analyze(input.data() + frame_index * CHANNELS_SIZE, block_size, stream_time)) {
+                packet_frames.push_back(frame_index + block_size);
+                packet_magnitudes.push_back(audio_capture.data[0]);
+            }
+        }
+    };
+
+    // Latency from the kick onset to the first packet reaching DETECTION_MAGNITUDE. Returns the number of detected kicks.
+    auto measure = [&](const std::vector<unsigned>& packet_frames, const std::vector<uint8_t>& packet_magnitudes, double& mean_latency_ms, double& max_latency_ms) {
+        unsigned detected       = 0;
+        double total_latency_ms = 0.;
+        max_latency_ms          = 0.;
+        for (unsigned onset : onsets) {
+            for (size_t packet_index = 0; packet_index < packet_frames.size(); ++packet_index) {
+                if ((packet_frames[packet_index] <= onset) || (packet_magnitudes[packet_index] < DETECTION_MAGNITUDE)) { continue; }
+                if (packet_frames[packet_index] >= onset + kick_interval_size) { break; }
+
+                double latency_ms = 1000. * static_cast<double>(packet_frames[packet_index] - onset) / static_cast<double>(SAMPLE_RATE);
+                total_latency_ms += latency_ms;
+                max_latency_ms    = std::max(max_latency_ms, latency_ms);
+                ++detected;
+                break;
+            }
+        }
+        mean_latency_ms = detected ? total_latency_ms / detected : 0.;
+        return detected;
+    };
+
+    for (analysis_t analysis : { analysis_t::fft, analysis_t::filterbank }) {
+        unsigned block_size = (analysis == analysis_t::filterbank) ? FILTERBANK_BUFFER_SIZE : INPUT_BUFFER_SIZE;
+
+        // Packets at the interval computed by prepare_analysis(), as they are sent to the devices
+        AudioCapture delivered_capture(analysis, packet_interval_ms, CHANNELS_SIZE, SAMPLE_RATE, block_size);
+        if (delivered_capture.prepare_analysis() != 0) { return; }
+
+        std::vector<unsigned> delivered_frames    = {};
+        std::vector<uint8_t> delivered_magnitudes = {};
+        ULONG64 start_cycles                      = 0;
+        ULONG64 end_cycles                        = 0;
+        QueryThreadCycleTime(GetCurrentThread(), &start_cycles);
+        double start_ms = get_thread_cpu_time_ms();
+        run(delivered_capture, block_size, delivered_frames, delivered_magnitudes);
+        double cpu_time_ms = get_thread_cpu_time_ms() - start_ms;
+        QueryThreadCycleTime(GetCurrentThread(), &end_cycles);
+
+        // Packets after every block, leaving out the wait for the packet interval
+        AudioCapture detection_capture(analysis, packet_interval_ms, CHANNELS_SIZE, SAMPLE_RATE, block_size);
+        if (detection_capture.prepare_analysis() != 0) { return; }
+        detection_capture.packet_interval_frames = block_size;
+
+        std::vector<unsigned> detection_frames    = {};
+        std::vector<uint8_t> detection_magnitudes = {};
+        run(detection_capture, block_size, detection_frames, detection_magnitudes);
+
+        double detection_mean_ms = 0.;
+        double detection_max_ms  = 0.;
+        double delivered_mean_ms = 0.;
+        double delivered_max_ms  = 0.;
+        unsigned detected        = measure(detection_frames, detection_magnitudes, detection_mean_ms, detection_max_ms);
+        unsigned delivered       = measure(delivered_frames, delivered_magnitudes, delivered_mean_ms, delivered_max_ms);
+
+        printf(
+            "[++++] %s analysis:\n\tBlock size: %u\n\tPacket interval: %u frames\n\tCPU time: %.3fms (%.3f%% of real time)\n\tCPU cycles: %.3fM\n"
+            "\tDetection latency (packet every block): %u/%u kicks, mean %.3fms, max %.3fms\n"
+            "\tDelivered latency (packet every interval): %u/%u kicks, mean %.3fms, max %.3fms\n",
+            (analysis == analysis_t::filterbank) ? "Filter bank" : "FFT",
+            block_size,
+            (analysis == analysis_t::filterbank) ? delivered_capture.packet_interval_frames : block_size,
+            cpu_time_ms,
+            100. * cpu_time_ms / static_cast<double>(DURATION_MS),
+            static_cast<double>(end_cycles - start_cycles) / 1e6,
+            detected,
+            static_cast<unsigned>(onsets.size()),
+            detection_mean_ms,
+            detection_max_ms,
+            delivered,
+            static_cast<unsigned>(onsets.size()),
+            delivered_mean_ms,
+            delivered_max_ms
+        );
+    }
+
+    printf("[INFO] Blocks were analyzed offline, the audio device may deliver callbacks less often than requested!\n");
+}
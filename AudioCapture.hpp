@@ -2,9 +2,20 @@
 
 #include "DataSender.hpp"
 #include "FFTW/fftw3.h"
+#include "FilterBank.hpp"
+#include "RealtimeProfile.hpp"
 #include "RtAudio/RtAudio.h"
 
 class AudioCapture {
+    public:
+        enum class analysis_t : uint8_t {
+            fft = 0,
+            filterbank,
+            undefined
+        };
+
+        constexpr static unsigned FILTERBANK_PACKET_INTERVAL_MS = 10; // Default, the FFT sends a packet every block
+
     private:
         constexpr static unsigned AUTOSCALE_TIME_WINDOW_MS = 1000;
         constexpr static double AUTOSCALE_VALUE            = 0.95;
@@ -12,6 +23,12 @@ class AudioCapture {
         constexpr static double MAX_FREQUENCY              = 2000.;
         constexpr static unsigned BINS_SIZE                = 20;
 
+        constexpr static unsigned FILTERBANK_BUFFER_SIZE = 64; // ~1.3ms at 48kHz, the filter bank doesn't need a full FFT window
+        constexpr static double FILTERBANK_ATTACK_MS     = 0.5;
+
+        constexpr static double SILENCE_RMS_THRESHOLD  = 0.0001; // -80 dBFS
+        constexpr static double SILENCE_PEAK_THRESHOLD = 0.001;  // -60 dBFS
+
         constexpr static double ENVELOPE_FOLLOWER_ATTACK  = 0.99; // Perceived as delay when peak is rising (higher is faster)
         constexpr static double ENVELOPE_FOLLOWER_RELEASE = 0.40; // Perceived as delay when peak is falling (higher is faster)
 
@@ -31,6 +48,18 @@ class AudioCapture {
                     }
                 }
 
+                // Equivalent to following a magnitude of 0, without computing the FFT
+                void decay_envelope(double release_factor) {
+                    this->magnitude = 0.;
+                    this->envelope *= release_factor;
+                }
+
+                // Same as above, additionally catching up on autoscale_count missed autoscales
+                void decay_envelope(double release_factor, unsigned autoscale_count) {
+                    this->decay_envelope(release_factor);
+                    this->max_envelope = std::max(this->max_envelope * std::pow(AUTOSCALE_VALUE, autoscale_count), this->envelope);
+                }
+
                 // Normalize between 0.0 - 1.0
                 double get_normalized_envelope(void) {
                     if (this->max_envelope == 0.) { return 0.; }
@@ -50,6 +79,10 @@ class AudioCapture {
         unsigned sample_rate                 = 0;
         unsigned input_buffer_size           = 0;
         unsigned output_buffer_size          = 0;
+        unsigned bins_size                   = 0;
+
+        analysis_t analysis  = analysis_t::fft;
+        double block_release = 0.; // Envelope factor of one block without any input, depends on the analysis
 
         std::vector<std::vector<Bin>> bins             = {}; // Channel dependent bins
         std::vector<unsigned> frame_index_to_bin_index = {}; // Cache frame index <> bin index for faster processing in record callback
@@ -59,22 +92,59 @@ class AudioCapture {
         fftw_complex* fftw_out          = nullptr;
         fftw_plan fftw                  = nullptr;
 
+        FilterBank filter_bank          = {};
+        unsigned packet_interval_ms     = FILTERBANK_PACKET_INTERVAL_MS;
+        unsigned packet_interval_frames = 0;
+        unsigned frames_since_packet    = 0;
+
         DataSender* data_sender   = nullptr;
         std::vector<uint8_t> data = {};
+        Packet packet             = Packet(Packet::destination_t::device, Packet::type_t::data, nullptr, 0); // Reused, so sending doesn't allocate
+
+        RealtimeProfile* realtime_profile = nullptr;
+        bool realtime_thread_is_applied   = false; // Only accessed by the RtAudio callback thread
+        HANDLE realtime_task              = NULL;  // RtAudio owns the callback thread without an exit hook, so the MMCSS registration lives as long as it does
+
+        double last_autoscale     = 0.;
+        bool autoscale_is_pending = false; // The filter bank doesn't emit a packet every block, so autoscales are deferred to the next packet
 
-        double last_autoscale = 0.;
+        // Silence fast path: once the envelopes have decayed and enough zero packets were sent, blocks are only counted
+        bool silence_is_settled    = false;
+        unsigned zero_packet_count = 0;
+        unsigned silent_blocks     = 0;
+        unsigned silent_autoscales = 0;
+
+        AudioCapture(analysis_t analysis, unsigned packet_interval_ms, unsigned channels_size, unsigned sample_rate, unsigned input_buffer_size, unsigned bins_size = BINS_SIZE);
 
         unsigned open_stream(void);
         unsigned close_stream(void);
+        unsigned prepare_analysis(void);
         void generate_bins();
+        void lock_buffers(void);
+
+        bool analyze(const double* input, unsigned frames_size, double stream_time);
+        void analyze_fft(const double* input, bool silent);
+        bool analyze_filterbank(const double* input, unsigned frames_size);
+        void weight_channel(unsigned channel_index, bool autoscale);
+
+        static bool is_silent(const double* samples, size_t samples_size);
 
         static int record(void* output_buffer, void* input_buffer, unsigned input_buffer_size, double stream_time, RtAudioStreamStatus status, void* user_data);
 
     public:
-        AudioCapture(DataSender* data_sender, unsigned input_buffer_size = INPUT_BUFFER_SIZE, unsigned bins_size = BINS_SIZE);
+        AudioCapture(
+            DataSender* data_sender,
+            RealtimeProfile* realtime_profile = nullptr,
+            analysis_t analysis               = analysis_t::fft,
+            unsigned packet_interval_ms       = FILTERBANK_PACKET_INTERVAL_MS,
+            unsigned input_buffer_size        = INPUT_BUFFER_SIZE,
+            unsigned bins_size                = BINS_SIZE
+        );
         ~AudioCapture(void);
 
         unsigned initialize(void);
 
+        static void benchmark(unsigned packet_interval_ms = FILTERBANK_PACKET_INTERVAL_MS);
+
         friend class Visualizer;
 };
@@ -1,6 +1,7 @@
 #include "DataSender.hpp"
 
 #include <algorithm>
+#include <cmath>
 #include <stdio.h>
 #include <string>
 #include <Ws2tcpip.h>
@@ -62,8 +63,25 @@ int DataSender::initialize(void) {
         return 1;
     }
 
+    // Reserve memory for jitter measurements
+    this->jitter_samples.resize(JITTER_SAMPLES_SIZE, 0);
+    if (this->realtime_profile) { this->realtime_profile->lock_buffer("jitter", this->jitter_samples); }
+
+    // Preallocate the send queue with maximum sized payloads, so copying packets into it never allocates
+    std::vector<uint8_t> max_payload(MAX_PAYLOAD_SIZE, 0);
+    this->send_queue.assign(SEND_QUEUE_SIZE, Packet(Packet::destination_t::undefined, Packet::type_t::undefined, max_payload.data(), max_payload.size()));
+    this->send_batch = this->send_queue;
+    this->send_buffer.resize(MAX_PACKET_SIZE, 0);
+    if (this->realtime_profile) {
+        for (size_t packet_index = 0; packet_index < SEND_QUEUE_SIZE; ++packet_index) {
+            this->realtime_profile->lock_buffer("send queue", this->send_queue[packet_index].get_payload_buffer());
+            this->realtime_profile->lock_buffer("send batch", this->send_batch[packet_index].get_payload_buffer());
+        }
+        this->realtime_profile->lock_buffer("send", this->send_buffer);
+    }
+
     // Initialize broadcast address
-    if (this->initialize_device("255.255.255.255") != 0) {
+    if (this->initialize_broadcast("255.255.255.255") != 0) {
         printf("[CRIT] Starting broadcast failed!\n");
         return 1;
     }
@@ -82,6 +100,20 @@ int DataSender::initialize(void) {
     return result;
 }
 
+int DataSender::initialize_broadcast(const char* broadcast_ip) {
+    this->broadcast_destination            = {};
+    this->broadcast_destination.sin_family = AF_INET;
+    this->broadcast_destination.sin_port   = htons(PORT);
+
+    // Check if broadcast_ip is valid
+    if (InetPton(AF_INET, broadcast_ip, &this->broadcast_destination.sin_addr.s_addr) != 1) {
+        printf("[CRIT] Invalid broadcast IP address %s!\n", broadcast_ip);
+        return 1;
+    }
+    return 0;
+}
+
+// Registers a device by IP, i.e., for manually added devices. Discovered devices are registered by the listen thread directly.
 int DataSender::initialize_device(const char* destination_ip) {
     sockaddr_in destination = {};
     destination.sin_family  = AF_INET;
@@ -89,7 +121,7 @@ int DataSender::initialize_device(const char* destination_ip) {
 
     // Check if destination_ip is valid
     if (InetPton(AF_INET, destination_ip, &destination.sin_addr.s_addr) == 1) {
-        this->destinations.push_back(destination);
+        if (this->device_registry.refresh(destination)) { printf("[++++] Registered sync device:\n\tIP: %s\n", destination_ip); }
     } else {
         printf("[CRIT] Invalid destination IP address %s!\n", destination_ip);
         return 1;
@@ -114,15 +146,15 @@ void DataSender::listen_thread(DataSender* data_sender) {
 
         if (packet.is_valid()) {
             if (packet.is_register()) {
-                std::scoped_lock lock(data_sender->destination_mutex);
+                // Registers new devices and refreshes the heartbeat of known ones. Data is always sent to PORT, regardless of the sender's port.
+                sockaddr_in destination = {};
+                destination.sin_family  = AF_INET;
+                destination.sin_port    = htons(PORT);
+                destination.sin_addr    = sender_addr.sin_addr;
 
-                // Check if destination is already registered. Add to vector if not.
-                if (!std::any_of(data_sender->destinations.begin(), data_sender->destinations.end(), [&](const auto& dest) {
-                        return dest.sin_addr.s_addr == sender_addr.sin_addr.s_addr;
-                    })) {
+                if (data_sender->device_registry.refresh(destination)) {
                     char sender_ip[INET_ADDRSTRLEN] = {};
                     InetNtop(AF_INET, &sender_addr.sin_addr, sender_ip, INET_ADDRSTRLEN);
-                    data_sender->initialize_device(sender_ip);
                     printf("[++++] Registered sync device:\n\tIP: %s\n", sender_ip);
                 }
             }
@@ -131,54 +163,97 @@ void DataSender::listen_thread(DataSender* data_sender) {
 }
 
 void DataSender::send_thread(DataSender* data_sender) {
+    HANDLE realtime_task = NULL;
+    if (data_sender->realtime_profile) { data_sender->realtime_profile->apply_send_thread(realtime_task); }
+
     while (data_sender->send_thread_is_running) {
         data_sender->send_thread_has_queued_data.wait(false);
 
+        // Only copy the queued packets while holding the lock, so enqueue() from the audio thread never waits behind the network
+        size_t batch_size = 0;
         {
             std::scoped_lock lock(data_sender->send_queue_mutex);
 
-            for (; !data_sender->send_queue.empty(); data_sender->send_queue.pop()) {
-                data_sender->send(data_sender->send_queue.front());
+            for (; data_sender->send_queue_size > 0; --data_sender->send_queue_size) {
+                data_sender->send_batch[batch_size++] = data_sender->send_queue[data_sender->send_queue_head];
+                data_sender->send_queue_head          = (data_sender->send_queue_head + 1) % data_sender->send_queue.size();
             }
+
+            // Cleared before unlocking, so packets enqueued while sending wake the thread up again
+            data_sender->send_thread_has_queued_data = false;
         }
 
-        data_sender->send_thread_has_queued_data = false;
+        for (size_t batch_index = 0; batch_index < batch_size; ++batch_index) {
+            data_sender->send(data_sender->send_batch[batch_index]);
+        }
     }
+
+    RealtimeProfile::revert_thread(realtime_task);
 }
 
 void DataSender::discover_thread(DataSender* data_sender) {
     while (data_sender->discover_thread_is_running) {
+        data_sender->device_registry.expire();
         data_sender->enqueue(Packet(Packet::destination_t::broadcast, Packet::type_t::discover, 0, 0));
-        std::this_thread::sleep_for(std::chrono::seconds(5));
+        std::this_thread::sleep_for(std::chrono::milliseconds(DISCOVER_INTERVAL_MS));
     }
 }
 
 void DataSender::enqueue(const Packet& packet) {
     std::scoped_lock lock(this->send_queue_mutex);
 
-    if (this->send_queue.size() < 10) {
-        this->send_queue.push(packet);
+    if (this->send_queue_size < this->send_queue.size()) {
+        this->send_queue[(this->send_queue_head + this->send_queue_size) % this->send_queue.size()] = packet;
+        ++this->send_queue_size;
         this->send_thread_has_queued_data = true;
         this->send_thread_has_queued_data.notify_all();
     }
 }
 
 bool DataSender::send(const Packet& packet) {
-    std::scoped_lock lock(this->destination_mutex);
+    bool success = true;
+
+    if (packet.is_data() && this->jitter_is_measuring.load(std::memory_order_acquire)) {
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+        // The first packet of a measurement has no predecessor to measure against
+        unsigned jitter_measurement = this->jitter_measurement.load(std::memory_order_relaxed);
+        if (this->jitter_last_measurement != jitter_measurement) {
+            this->jitter_last_measurement = jitter_measurement;
+        } else {
+            unsigned sample_index = this->jitter_samples_count.load(std::memory_order_relaxed);
+            if (sample_index < this->jitter_samples.size()) {
+                this->jitter_samples[sample_index] = std::chrono::duration_cast<std::chrono::microseconds>(now - this->jitter_last_data_packet).count();
+                this->jitter_samples_count.store(sample_index + 1, std::memory_order_release);
+            }
+        }
+        this->jitter_last_data_packet = now;
+    }
 
     // Check if zero data packets are sent repeatedly. If so, skip after RESEND_ZERO_PACKET_COUNT to free up network bandwidth.
     if (!packet.is_zero() || (this->zero_packet_count++ < RESEND_ZERO_PACKET_COUNT)) {
-        std::vector<uint8_t> raw = packet.to_raw();
+        packet.to_raw(this->send_buffer);
+        const std::vector<uint8_t>& raw = this->send_buffer;
         switch (packet.get_destination()) {
             case Packet::destination_t::broadcast: {
-                if (!this->send_raw(reinterpret_cast<const sockaddr*>(&this->destinations[0]), raw)) { // First address is broadcast
-                    return false;
-                }
+                success = this->send_raw(reinterpret_cast<const sockaddr*>(&this->broadcast_destination), raw);
                 break;
             }
             case Packet::destination_t::device: {
-                for (size_t destination_index = 1; destination_index < this->destinations.size(); ++destination_index) {
-                    if (!this->send_raw(reinterpret_cast<const sockaddr*>(&this->destinations[destination_index]), raw)) { return false; }
+                // Lock-free: the snapshot only changes when devices are added or expired
+                const DeviceRegistry::snapshot_t& devices      = this->device_registry.get_snapshot();
+                DeviceRegistry::steady_clock_t::time_point now = DeviceRegistry::steady_clock_t::now();
+
+                for (const std::shared_ptr<DeviceRegistry::Device>& device : devices) {
+                    if (device->is_backing_off(now)) { continue; }
+
+                    // A failing device must not stall the remaining ones
+                    if (this->send_raw(reinterpret_cast<const sockaddr*>(&device->address), raw)) {
+                        device->report_success();
+                    } else {
+                        device->report_error(now);
+                        success = false;
+                    }
                 }
                 break;
             }
@@ -187,7 +262,7 @@ bool DataSender::send(const Packet& packet) {
         // Only reset when packet is not zero
         if (!packet.is_zero()) { this->zero_packet_count = 0; }
     }
-    return true;
+    return success;
 }
 
 bool DataSender::send_raw(const sockaddr* address, const std::vector<uint8_t>& packet) {
@@ -197,3 +272,53 @@ bool DataSender::send_raw(const sockaddr* address, const std::vector<uint8_t>& p
     }
     return true;
 }
+
+void DataSender::measure_jitter(unsigned duration_ms) {
+    printf(
+        "[INFO] Measuring data packet intervals for %ums (real-time profile %s)...\n",
+        duration_ms,
+        (this->realtime_profile && this->realtime_profile->is_enabled()) ? "enabled" : "disabled"
+    );
+
+    this->jitter_samples_count.store(0, std::memory_order_relaxed);
+    this->jitter_measurement.fetch_add(1, std::memory_order_relaxed);
+    this->jitter_is_measuring.store(true, std::memory_order_release);
+    std::this_thread::sleep_for(std::chrono::milliseconds(duration_ms));
+    this->jitter_is_measuring.store(false, std::memory_order_release);
+
+    // Only samples published before this load are read, the send thread never rewrites them during this measurement
+    unsigned samples_count = this->jitter_samples_count.load(std::memory_order_acquire);
+    std::vector<long long> samples(this->jitter_samples.begin(), this->jitter_samples.begin() + samples_count);
+    if (samples.size() < 2) {
+        printf("[CRIT] Not enough data packets were sent to measure jitter!\n");
+        return;
+    }
+    std::sort(samples.begin(), samples.end());
+
+    double mean = 0.;
+    for (long long sample : samples) {
+        mean += static_cast<double>(sample);
+    }
+    mean /= static_cast<double>(samples.size());
+
+    double variance = 0.;
+    for (long long sample : samples) {
+        variance += (static_cast<double>(sample) - mean) * (static_cast<double>(sample) - mean);
+    }
+    variance /= static_cast<double>(samples.size());
+
+    auto percentile = [&](double p) { return samples[std::min(static_cast<size_t>(p * samples.size()), samples.size() - 1)] / 1000.; };
+
+    printf(
+        "[++++] Data packet intervals (%zu samples):\n\tMin: %.3fms\n\tMean: %.3fms\n\tStd dev: %.3fms\n\tP50: %.3fms\n\tP90: %.3fms\n\tP99: %.3fms\n\tP99.9: %.3fms\n\tMax: %.3fms\n",
+        samples.size(),
+        samples.front() / 1000.,
+        mean / 1000.,
+        std::sqrt(variance) / 1000.,
+        percentile(0.50),
+        percentile(0.90),
+        percentile(0.99),
+        percentile(0.999),
+        samples.back() / 1000.
+    );
+}
@@ -2,21 +2,34 @@
 
 #define NOMINMAX
 
+#include "DeviceRegistry.hpp"
 #include "Packet.hpp"
+#include "RealtimeProfile.hpp"
 
 #include <atomic>
+#include <chrono>
 #include <mutex>
-#include <queue>
 #include <thread>
 #include <vector>
 #include <winsock2.h>
 
 class DataSender {
-    private:
-        constexpr static unsigned short PORT               = 3333;
+    public:
         constexpr static unsigned RESEND_ZERO_PACKET_COUNT = 5;
+        constexpr static unsigned MIN_PACKET_INTERVAL_MS   = 1; // Lower bound of the filter bank packet interval, the FFT sends one packet per block (~21ms at 48kHz)
+        constexpr static unsigned JITTER_MEASUREMENT_MS    = 10000;
+
+    private:
+        constexpr static unsigned short PORT           = 3333;
+        constexpr static unsigned DISCOVER_INTERVAL_MS = 5000;
+        constexpr static unsigned JITTER_SAMPLES_SIZE  = JITTER_MEASUREMENT_MS / MIN_PACKET_INTERVAL_MS; // Enough for a whole measurement at the fastest packet rate
+        constexpr static unsigned SEND_QUEUE_SIZE      = 10;
+        constexpr static size_t MAX_PAYLOAD_SIZE       = 255; // <LEN> is a single byte
+        constexpr static size_t MAX_PACKET_SIZE        = MAX_PAYLOAD_SIZE + 4;
 
     private:
+        RealtimeProfile* realtime_profile = nullptr;
+
         WSADATA wsa_data = {};
         SOCKET socket    = INVALID_SOCKET;
 
@@ -32,20 +45,35 @@ class DataSender {
 
         std::atomic<unsigned> zero_packet_count = 0;
 
-        std::mutex send_queue_mutex   = {};
-        std::queue<Packet> send_queue = {};
-
-        std::mutex destination_mutex          = {};
-        std::vector<sockaddr_in> destinations = {};
+        // Inter-packet intervals of data packets in microseconds, preallocated so measuring doesn't allocate in the send path
+        std::atomic<bool> jitter_is_measuring                         = false;
+        std::atomic<unsigned> jitter_measurement                      = 0;  // Incremented for every measurement, so the send thread detects a new one
+        std::atomic<unsigned> jitter_samples_count                    = 0;  // Published with release ordering after a sample was written
+        unsigned jitter_last_measurement                              = 0;  // Only accessed by the send thread
+        std::chrono::steady_clock::time_point jitter_last_data_packet = {}; // Only accessed by the send thread
+        std::vector<long long> jitter_samples                         = {};
+
+        // Ring of preallocated packets, so enqueueing from the audio thread doesn't allocate
+        std::mutex send_queue_mutex      = {};
+        std::vector<Packet> send_queue   = {};
+        size_t send_queue_head           = 0;
+        size_t send_queue_size           = 0;
+        std::vector<Packet> send_batch   = {}; // Packets taken from the ring, only accessed by the send thread so sending doesn't hold the lock
+        std::vector<uint8_t> send_buffer = {}; // Raw packet, only accessed by the send thread
+
+        sockaddr_in broadcast_destination = {};
+        DeviceRegistry device_registry    = DeviceRegistry(DISCOVER_INTERVAL_MS);
 
         bool send(const Packet& packet);
         bool send_raw(const sockaddr* address, const std::vector<uint8_t>& packet);
 
     public:
-        DataSender(void) = default;
+        DataSender(RealtimeProfile* realtime_profile = nullptr) : realtime_profile(realtime_profile) { }
+
         ~DataSender(void);
 
         int initialize(void);
+        int initialize_broadcast(const char* broadcast_ip);
         int initialize_device(const char* destination_ip);
 
         static void listen_thread(DataSender* data_sender);
@@ -53,4 +81,5 @@ class DataSender {
         static void discover_thread(DataSender* data_sender);
 
         void enqueue(const Packet& packet);
+        void measure_jitter(unsigned duration_ms);
 };
@@ -0,0 +1,57 @@
+#include "DeviceRegistry.hpp"
+
+#include <stdio.h>
+#include <Ws2tcpip.h>
+
+void DeviceRegistry::publish(void) {
+    // Caller must hold the mutex
+    std::unique_ptr<snapshot_t> snapshot = std::make_unique<snapshot_t>();
+    snapshot->reserve(this->devices.size());
+    for (const auto& [key, device] : this->devices) {
+        snapshot->push_back(device);
+    }
+
+    const snapshot_t* current = snapshot.get();
+    this->snapshots.push_back(std::move(snapshot));
+    this->snapshot.store(current, std::memory_order_seq_cst);
+
+    // The reader can't announce a retired snapshot anymore after the store above, so everything but the current and the announced one can be freed
+    const snapshot_t* in_use = this->snapshot_in_use.load(std::memory_order_seq_cst);
+    std::erase_if(this->snapshots, [&](const std::unique_ptr<const snapshot_t>& retired) { return (retired.get() != current) && (retired.get() != in_use); });
+}
+
+// Returns true if the device was not registered before
+bool DeviceRegistry::refresh(const sockaddr_in& address) {
+    std::scoped_lock lock(this->mutex);
+
+    steady_clock_t::time_point now = steady_clock_t::now();
+
+    auto it = this->devices.find(make_key(address));
+    if (it != this->devices.end()) {
+        it->second->last_seen = now;
+        return false;
+    }
+
+    this->devices.emplace(make_key(address), std::make_shared<Device>(address, now));
+    this->publish();
+    return true;
+}
+
+// Removes all devices that haven't been seen for device_timeout_ms. Returns the number of removed devices.
+size_t DeviceRegistry::expire(void) {
+    std::scoped_lock lock(this->mutex);
+
+    steady_clock_t::time_point deadline = steady_clock_t::now() - std::chrono::milliseconds(this->device_timeout_ms);
+
+    size_t removed = std::erase_if(this->devices, [&](const auto& entry) {
+        if (entry.second->last_seen >= deadline) { return false; }
+
+        char device_ip[INET_ADDRSTRLEN] = {};
+        InetNtop(AF_INET, &entry.second->address.sin_addr, device_ip, INET_ADDRSTRLEN);
+        printf("[----] Unregistered silent sync device:\n\tIP: %s\n\tSend errors: %u\n", device_ip, entry.second->error_count.load());
+        return true;
+    });
+
+    if (removed) { this->publish(); }
+    return removed;
+}
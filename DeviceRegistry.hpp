@@ -0,0 +1,89 @@
+#pragma once
+
+#define NOMINMAX
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+#include <winsock2.h>
+
+class DeviceRegistry {
+    public:
+        constexpr static unsigned TIMEOUT_DISCOVER_ROUNDS = 3; // Devices answer every discover round, so this tolerates two lost rounds
+        constexpr static unsigned TIMEOUT_SLACK_MS        = 1000;
+        constexpr static unsigned BACKOFF_BASE_MS         = 100;
+        constexpr static unsigned BACKOFF_MAX_MS          = 5000;
+
+        using steady_clock_t = std::chrono::steady_clock;
+
+        struct Device {
+            public:
+                sockaddr_in address                  = {};
+                steady_clock_t::time_point last_seen = {}; // Only touched while holding the registry mutex
+
+                // Only touched by the send thread, atomic so the registry can read them for logging
+                std::atomic<unsigned> error_count                    = 0;
+                std::atomic<steady_clock_t::rep> backoff_until_ticks = 0;
+
+                Device(const sockaddr_in& address, steady_clock_t::time_point last_seen) : address(address), last_seen(last_seen) { }
+
+                bool is_backing_off(steady_clock_t::time_point now) const { return now.time_since_epoch().count() < this->backoff_until_ticks; }
+
+                void report_success(void) {
+                    if (this->error_count == 0) { return; }
+                    this->error_count         = 0;
+                    this->backoff_until_ticks = 0;
+                }
+
+                // Exponential backoff: BACKOFF_BASE_MS, 2 * BACKOFF_BASE_MS, ... capped at BACKOFF_MAX_MS
+                void report_error(steady_clock_t::time_point now) {
+                    unsigned errors           = ++this->error_count;
+                    unsigned backoff          = (errors > 16) ? BACKOFF_MAX_MS : std::min(BACKOFF_BASE_MS << (errors - 1), BACKOFF_MAX_MS);
+                    this->backoff_until_ticks = (now + std::chrono::milliseconds(backoff)).time_since_epoch().count();
+                }
+        };
+
+        // Immutable list of live devices, republished whenever a device is added or removed
+        using snapshot_t = std::vector<std::shared_ptr<Device>>;
+
+    private:
+        unsigned device_timeout_ms = 0;
+
+        std::mutex mutex                                              = {};
+        std::unordered_map<uint64_t, std::shared_ptr<Device>> devices = {}; // Keyed by address and port, see make_key()
+
+        // std::atomic<std::shared_ptr> isn't lock-free on MSVC, so snapshots are published as raw pointers instead.
+        // The single reader announces the snapshot it iterates in snapshot_in_use (a hazard pointer), publish() frees all others.
+        std::vector<std::unique_ptr<const snapshot_t>> snapshots = {}; // Published and retired snapshots, only touched while holding the mutex
+        std::atomic<const snapshot_t*> snapshot                  = nullptr;
+        std::atomic<const snapshot_t*> snapshot_in_use           = nullptr;
+
+        static uint64_t make_key(const sockaddr_in& address) { return (static_cast<uint64_t>(address.sin_addr.s_addr) << 16) | address.sin_port; }
+
+        void publish(void);
+
+    public:
+        DeviceRegistry(unsigned discover_interval_ms) : device_timeout_ms(TIMEOUT_DISCOVER_ROUNDS * discover_interval_ms + TIMEOUT_SLACK_MS) {
+            this->publish();
+        }
+
+        ~DeviceRegistry(void) = default;
+
+        bool refresh(const sockaddr_in& address);
+        size_t expire(void);
+
+        // Lock-free, the returned snapshot stays valid until the next call. Must only be called from a single thread, i.e., the send thread.
+        const snapshot_t& get_snapshot(void) {
+            const snapshot_t* snapshot = nullptr;
+            do {
+                snapshot = this->snapshot.load(std::memory_order_seq_cst);
+                this->snapshot_in_use.store(snapshot, std::memory_order_seq_cst);
+            } while (snapshot != this->snapshot.load(std::memory_order_seq_cst)); // Retry if it may have been freed before it was announced
+            return *snapshot;
+        }
+};
@@ -0,0 +1,100 @@
+#include "FilterBank.hpp"
+
+#define _USE_MATH_DEFINES
+
+#include <algorithm>
+#include <emmintrin.h>
+#include <math.h>
+
+void FilterBank::initialize(unsigned sample_rate, unsigned channels_size, unsigned bands_size, double attack_ms, double release_ms) {
+    this->channels_size = channels_size;
+    this->bands_size    = bands_size;
+    this->bands_stride  = (bands_size + 1) & ~1u;
+
+    // One-pole coefficients reaching 63% of a step within the given time
+    this->attack  = 1. - exp(-1000. / (attack_ms * sample_rate));
+    this->release = 1. - exp(-1000. / (release_ms * sample_rate));
+
+    this->b0.assign(this->bands_stride, 0.);
+    this->b1.assign(this->bands_stride, 0.);
+    this->b2.assign(this->bands_stride, 0.);
+    this->a1.assign(this->bands_stride, 0.);
+    this->a2.assign(this->bands_stride, 0.);
+
+    this->z1.assign(this->channels_size * this->bands_stride, 0.);
+    this->z2.assign(this->channels_size * this->bands_stride, 0.);
+    this->envelope.assign(this->channels_size * this->bands_stride, 0.);
+}
+
+// Band-pass with 0 dB peak gain (RBJ audio EQ cookbook), centered in the bin
+void FilterBank::set_band(unsigned sample_rate, unsigned band_index, double lower_frequency, double upper_frequency) {
+    double center_frequency = 0.5 * (lower_frequency + upper_frequency);
+    double quality          = center_frequency / std::max(upper_frequency - lower_frequency, 1.);
+    double omega            = 2. * M_PI * center_frequency / static_cast<double>(sample_rate);
+    double alpha            = sin(omega) / (2. * quality);
+    double a0               = 1. + alpha;
+
+    this->b0[band_index] = alpha / a0;
+    this->b1[band_index] = 0.;
+    this->b2[band_index] = -alpha / a0;
+    this->a1[band_index] = -2. * cos(omega) / a0;
+    this->a2[band_index] = (1. - alpha) / a0;
+}
+
+void FilterBank::reset(void) {
+    std::fill(this->z1.begin(), this->z1.end(), 0.);
+    std::fill(this->z2.begin(), this->z2.end(), 0.);
+    std::fill(this->envelope.begin(), this->envelope.end(), 0.);
+}
+
+void FilterBank::lock_buffers(RealtimeProfile* realtime_profile) {
+    if (!realtime_profile) { return; }
+
+    realtime_profile->lock_buffer("filter bank coefficients", this->b0);
+    realtime_profile->lock_buffer("filter bank coefficients", this->b1);
+    realtime_profile->lock_buffer("filter bank coefficients", this->b2);
+    realtime_profile->lock_buffer("filter bank coefficients", this->a1);
+    realtime_profile->lock_buffer("filter bank coefficients", this->a2);
+    realtime_profile->lock_buffer("filter bank states", this->z1);
+    realtime_profile->lock_buffer("filter bank states", this->z2);
+    realtime_profile->lock_buffer("filter bank envelopes", this->envelope);
+}
+
+void FilterBank::process(const double* input, unsigned frames_size) {
+    const __m128d sign_mask = _mm_set1_pd(-0.);
+    const __m128d attack    = _mm_set1_pd(this->attack);
+    const __m128d release   = _mm_set1_pd(this->release);
+
+    for (unsigned channel_index = 0; channel_index < this->channels_size; ++channel_index) {
+        double* z1       = this->z1.data() + channel_index * this->bands_stride;
+        double* z2       = this->z2.data() + channel_index * this->bands_stride;
+        double* envelope = this->envelope.data() + channel_index * this->bands_stride;
+
+        for (unsigned frame_index = 0; frame_index < frames_size; ++frame_index) {
+            __m128d x = _mm_set1_pd(input[frame_index * this->channels_size + channel_index]);
+
+            for (unsigned band_index = 0; band_index < this->bands_stride; band_index += 2) {
+                __m128d s1 = _mm_loadu_pd(z1 + band_index);
+                __m128d s2 = _mm_loadu_pd(z2 + band_index);
+                __m128d e  = _mm_loadu_pd(envelope + band_index);
+
+                // y = b0 * x + z1, z1 = b1 * x - a1 * y + z2, z2 = b2 * x - a2 * y
+                __m128d y = _mm_add_pd(_mm_mul_pd(_mm_loadu_pd(this->b0.data() + band_index), x), s1);
+                s1        = _mm_add_pd(
+                    _mm_sub_pd(_mm_mul_pd(_mm_loadu_pd(this->b1.data() + band_index), x), _mm_mul_pd(_mm_loadu_pd(this->a1.data() + band_index), y)), s2
+                );
+                s2 = _mm_sub_pd(_mm_mul_pd(_mm_loadu_pd(this->b2.data() + band_index), x), _mm_mul_pd(_mm_loadu_pd(this->a2.data() + band_index), y));
+
+                // Follow the rectified output, attack when rising and release when falling
+                __m128d rectified   = _mm_andnot_pd(sign_mask, y);
+                __m128d rising      = _mm_cmpgt_pd(rectified, e);
+                __m128d coefficient = _mm_or_pd(_mm_and_pd(rising, attack), _mm_andnot_pd(rising, release));
+                e                   = _mm_add_pd(e, _mm_mul_pd(coefficient, _mm_sub_pd(rectified, e)));
+
+                _mm_storeu_pd(z1 + band_index, s1);
+                _mm_storeu_pd(z2 + band_index, s2);
+                _mm_storeu_pd(envelope + band_index, e);
+            }
+        }
+    }
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "RealtimeProfile.hpp"
+
+#include <vector>
+
+// Bank of biquad band-pass filters with per-band envelope followers, processed sample by sample.
+// Coefficients and states are stored band-contiguous per channel so two bands are processed per SSE2 instruction.
+class FilterBank {
+    private:
+        unsigned channels_size = 0;
+        unsigned bands_size    = 0;
+        unsigned bands_stride  = 0; // bands_size rounded up to a multiple of two, padding bands have zero coefficients
+
+        double attack  = 0.; // Per-sample envelope follower coefficients
+        double release = 0.;
+
+        // Transposed direct form II coefficients, shared by all channels
+        std::vector<double> b0 = {};
+        std::vector<double> b1 = {};
+        std::vector<double> b2 = {};
+        std::vector<double> a1 = {};
+        std::vector<double> a2 = {};
+
+        // Channel dependent states
+        std::vector<double> z1       = {};
+        std::vector<double> z2       = {};
+        std::vector<double> envelope = {};
+
+    public:
+        FilterBank(void)  = default;
+        ~FilterBank(void) = default;
+
+        void initialize(unsigned sample_rate, unsigned channels_size, unsigned bands_size, double attack_ms, double release_ms);
+        void set_band(unsigned sample_rate, unsigned band_index, double lower_frequency, double upper_frequency);
+        void reset(void);
+        void lock_buffers(RealtimeProfile* realtime_profile);
+
+        void process(const double* input, unsigned frames_size);
+
+        double get_envelope(unsigned channel_index, unsigned band_index) const { return this->envelope[channel_index * this->bands_stride + band_index]; }
+
+        double get_release(void) const { return this->release; }
+};
@@ -63,6 +63,9 @@ class Packet {
 
         size_t get_payload_size(void) const { return this->payload.size(); }
 
+        // Payload storage, i.e., to lock preallocated packets into memory
+        std::vector<uint8_t>& get_payload_buffer(void) { return this->payload; }
+
         bool is_valid(void) const { return (this->type != type_t::undefined); }
 
         bool is_discover(void) const {
@@ -80,6 +83,12 @@ class Packet {
             return false;
         }
 
+        // Reuses the payload's memory if it is large enough, i.e., for preallocated packets
+        void set_payload(const uint8_t* payload, const size_t payload_size) {
+            this->payload.resize(payload_size);
+            memcpy(this->payload.data(), payload, payload_size);
+        }
+
         bool is_zero(void) const {
             if (!this->is_data()) { return false; }
             for (size_t index = 0; index < this->payload.size(); ++index) {
@@ -89,13 +98,19 @@ class Packet {
         }
 
         std::vector<uint8_t> to_raw(void) const {
-            std::vector<uint8_t> packet(this->payload.size() + PACKET_LENGTH_OVERHEAD);
+            std::vector<uint8_t> packet;
+            this->to_raw(packet);
+            return packet;
+        }
+
+        // Reuses the memory of packet if it is large enough
+        void to_raw(std::vector<uint8_t>& packet) const {
+            packet.resize(this->payload.size() + PACKET_LENGTH_OVERHEAD);
             packet[0] = STX;
             packet[1] = static_cast<uint8_t>(this->type);
             packet[2] = this->payload.size();
             memcpy(packet.data() + 3, this->payload.data(), this->payload.size());
             packet.back() = ETX;
-            return packet;
         }
 
         const char* c_str(void) const {
@@ -0,0 +1,101 @@
+#include "RealtimeProfile.hpp"
+
+#include <algorithm>
+#include <avrt.h>
+#include <stdio.h>
+
+// Link with avrt.lib for MMCSS
+#pragma comment(lib, "Avrt.lib")
+
+// The priority class is left unchanged, as it would also raise the listen, discover and console threads. Only apply_thread() raises priorities.
+unsigned RealtimeProfile::apply_process(void) {
+    if (!this->config.enabled) { return 0; }
+
+    unsigned result = 0;
+
+    // Closest equivalent to mlockall(): pages inside the minimum working set are never trimmed
+    if (!SetProcessWorkingSetSize(GetCurrentProcess(), WORKING_SET_MINIMUM, WORKING_SET_MAXIMUM)) {
+        printf("[WARN] Raising the working set size failed with error code %lu!\n", GetLastError());
+        result = 1;
+    }
+
+    if (result == 0) {
+        printf("[INFO] Real-time profile enabled:\n\tAudio core: %d\n\tSend core: %d\n", this->config.audio_core, this->config.send_core);
+    } else {
+        printf("[WARN] Real-time profile only partially enabled:\n\tAudio core: %d\n\tSend core: %d\n", this->config.audio_core, this->config.send_core);
+    }
+    return result;
+}
+
+unsigned RealtimeProfile::apply_thread(const char* name, int core, HANDLE& task) {
+    task = NULL;
+    if (!this->config.enabled) { return 0; }
+
+    unsigned result = 0;
+
+    // Register with the Multimedia Class Scheduler Service, which boosts the thread into the realtime range
+    DWORD task_index = 0;
+    task             = AvSetMmThreadCharacteristicsA("Pro Audio", &task_index);
+    if (task == NULL) {
+        printf("[WARN] Registering the %s thread with MMCSS failed with error code %lu!\n", name, GetLastError());
+        result = 1;
+    } else if (!AvSetMmThreadPriority(task, AVRT_PRIORITY_CRITICAL)) {
+        printf("[WARN] Setting the MMCSS priority of the %s thread failed with error code %lu!\n", name, GetLastError());
+        result = 1;
+    }
+
+    if (!SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL)) {
+        printf("[WARN] Setting the priority of the %s thread failed with error code %lu!\n", name, GetLastError());
+        result = 1;
+    }
+
+    if (core >= 0) {
+        if (!is_valid_core(core)) {
+            printf("[WARN] Not pinning the %s thread to invalid core %d!\n", name, core);
+            result = 1;
+        } else if (SetThreadAffinityMask(GetCurrentThread(), static_cast<DWORD_PTR>(1) << core) == 0) {
+            printf("[WARN] Pinning the %s thread to core %d failed with error code %lu!\n", name, core, GetLastError());
+            result = 1;
+        }
+    }
+
+    prefault_stack();
+    return result;
+}
+
+void RealtimeProfile::revert_thread(HANDLE task) {
+    if (task == NULL) { return; }
+
+    if (!AvRevertMmThreadCharacteristics(task)) { printf("[WARN] Reverting the MMCSS registration failed with error code %lu!\n", GetLastError()); }
+}
+
+// Affinity masks only cover as many cores as DWORD_PTR has bits
+bool RealtimeProfile::is_valid_core(int core) {
+    DWORD cores_size = std::min<DWORD>(GetActiveProcessorCount(ALL_PROCESSOR_GROUPS), sizeof(DWORD_PTR) * 8);
+    return (core >= 0) && (static_cast<DWORD>(core) < cores_size);
+}
+
+__declspec(noinline) void RealtimeProfile::prefault_stack(void) {
+    // Touch the stack once so the first deep call in the hot path doesn't page fault
+    volatile unsigned char stack[STACK_PREFAULT_SIZE];
+    for (size_t index = 0; index < STACK_PREFAULT_SIZE; index += 4096) {
+        stack[index] = 0;
+    }
+}
+
+unsigned RealtimeProfile::lock_buffer(const char* name, void* buffer, size_t size) {
+    if (!this->config.enabled || (buffer == nullptr) || (size == 0)) { return 0; }
+
+    // Pre-fault every page, then pin them into physical memory
+    volatile unsigned char* bytes = reinterpret_cast<volatile unsigned char*>(buffer);
+    for (size_t index = 0; index < size; index += 4096) {
+        bytes[index] = bytes[index];
+    }
+    bytes[size - 1] = bytes[size - 1];
+
+    if (!VirtualLock(buffer, size)) {
+        printf("[WARN] Locking the %s buffer failed with error code %lu!\n", name, GetLastError());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#define NOMINMAX
+
+#include <stddef.h>
+#include <vector>
+#include <Windows.h>
+
+class RealtimeProfile {
+    public:
+        struct Config {
+            public:
+                bool enabled   = false;
+                int audio_core = -1; // -1 leaves the affinity to the scheduler
+                int send_core  = -1;
+        };
+
+    private:
+        constexpr static SIZE_T WORKING_SET_MINIMUM = 64 * 1024 * 1024; // VirtualLock can only lock pages within the minimum working set
+        constexpr static SIZE_T WORKING_SET_MAXIMUM = 128 * 1024 * 1024;
+        constexpr static size_t STACK_PREFAULT_SIZE = 64 * 1024;
+
+        Config config = {};
+
+        unsigned apply_thread(const char* name, int core, HANDLE& task);
+        static void prefault_stack(void);
+
+    public:
+        RealtimeProfile(const Config& config) : config(config) { }
+
+        ~RealtimeProfile(void) = default;
+
+        bool is_enabled(void) const { return this->config.enabled; }
+
+        unsigned apply_process(void);
+
+        // task receives the MMCSS handle, which must be passed to revert_thread() before the thread exits
+        unsigned apply_audio_thread(HANDLE& task) { return this->apply_thread("audio", this->config.audio_core, task); }
+
+        unsigned apply_send_thread(HANDLE& task) { return this->apply_thread("send", this->config.send_core, task); }
+
+        static void revert_thread(HANDLE task);
+
+        static bool is_valid_core(int core);
+
+        unsigned lock_buffer(const char* name, void* buffer, size_t size);
+
+        template <typename T>
+        unsigned lock_buffer(const char* name, std::vector<T>& buffer) {
+            return this->lock_buffer(name, buffer.data(), buffer.size() * sizeof(T));
+        }
+};
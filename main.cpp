@@ -1,15 +1,60 @@
 #include "AudioCapture.hpp"
 #include "DataSender.hpp"
+#include "RealtimeProfile.hpp"
 
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 // Link with ws2_32.lib
 #pragma comment(lib, "Ws2_32.lib")
 
+constexpr long MAX_PACKET_INTERVAL_MS = 1000;
+
 DataSender* data_sender     = nullptr;
 AudioCapture* audio_capture = nullptr;
 
+// Returns -1 (no pinning) for anything but a whole number of an active core
+int parse_core(const char* argument, const char* value) {
+    char* end = nullptr;
+    long core = strtol(value, &end, 10);
+    if ((end == value) || (*end != '\0') || (core < 0) || (core > INT_MAX) || !RealtimeProfile::is_valid_core(static_cast<int>(core))) {
+        printf("[WARN] Ignoring invalid core in argument %s!\n", argument);
+        return -1;
+    }
+    return static_cast<int>(core);
+}
+
+// Returns the default interval for anything but a whole number of milliseconds within [MIN_PACKET_INTERVAL_MS, MAX_PACKET_INTERVAL_MS]
+unsigned parse_packet_interval(const char* argument, const char* value) {
+    char* end        = nullptr;
+    long interval_ms = strtol(value, &end, 10);
+    if ((end == value) || (*end != '\0') || (interval_ms < static_cast<long>(DataSender::MIN_PACKET_INTERVAL_MS)) || (interval_ms > MAX_PACKET_INTERVAL_MS)) {
+        printf("[WARN] Ignoring invalid packet interval in argument %s!\n", argument);
+        return AudioCapture::FILTERBANK_PACKET_INTERVAL_MS;
+    }
+    return static_cast<unsigned>(interval_ms);
+}
+
+void parse_arguments(int argc, char** argv, RealtimeProfile::Config& realtime_config, AudioCapture::analysis_t& analysis, unsigned& packet_interval_ms) {
+    for (int index = 1; index < argc; ++index) {
+        if (strcmp(argv[index], "--realtime") == 0) {
+            realtime_config.enabled = true;
+        } else if (strncmp(argv[index], "--audio-core=", 13) == 0) {
+            realtime_config.audio_core = parse_core(argv[index], argv[index] + 13);
+        } else if (strncmp(argv[index], "--send-core=", 12) == 0) {
+            realtime_config.send_core = parse_core(argv[index], argv[index] + 12);
+        } else if (strcmp(argv[index], "--filterbank") == 0) {
+            analysis = AudioCapture::analysis_t::filterbank;
+        } else if (strncmp(argv[index], "--packet-interval-ms=", 21) == 0) {
+            packet_interval_ms = parse_packet_interval(argv[index], argv[index] + 21);
+        } else {
+            printf("[WARN] Ignoring unknown argument %s!\n", argv[index]);
+        }
+    }
+}
+
 int cleanup_and_exit(int code) {
     if (data_sender) { delete data_sender; }
     if (audio_capture) { delete audio_capture; }
@@ -17,15 +62,23 @@ int cleanup_and_exit(int code) {
     return code;
 }
 
-int main() {
+int main(int argc, char** argv) {
     printf("[LightStripAudioSync]\n\n");
 
+    RealtimeProfile::Config realtime_config = {};
+    AudioCapture::analysis_t analysis       = AudioCapture::analysis_t::fft;
+    unsigned packet_interval_ms             = AudioCapture::FILTERBANK_PACKET_INTERVAL_MS;
+    parse_arguments(argc, argv, realtime_config, analysis, packet_interval_ms);
+
+    RealtimeProfile realtime_profile(realtime_config);
+    realtime_profile.apply_process();
+
     printf("[INFO] Starting data sender...\n");
-    data_sender = new DataSender();
+    data_sender = new DataSender(&realtime_profile);
     if (!data_sender || data_sender->initialize() != 0) { return cleanup_and_exit(1); }
 
     printf("[INFO] Starting audio capture...\n");
-    audio_capture = new AudioCapture(data_sender);
+    audio_capture = new AudioCapture(data_sender, &realtime_profile, analysis, packet_interval_ms);
     if (!audio_capture || audio_capture->initialize() != 0) { return cleanup_and_exit(1); }
 
     char input;
@@ -36,7 +89,13 @@ int main() {
         if (input == "help" || input == "?") {
             printf("Available commands:\n");
             printf("  help, ?       Show this help message\n");
+            printf("  jitter        Measure the data packet interval distribution\n");
+            printf("  benchmark     Compare CPU time and latency of the FFT and filter bank analyses\n");
             printf("  exit, quit    Exit the program\n");
+        } else if (input == "jitter") {
+            data_sender->measure_jitter(DataSender::JITTER_MEASUREMENT_MS);
+        } else if (input == "benchmark") {
+            AudioCapture::benchmark(packet_interval_ms);
         } else if (input == "exit" || input == "quit" || input == "q") {
             break;
         } else {